@@ -10,6 +10,7 @@
 
 #include "TTree.h"
 
+#include <string>
 #include <vector>
 
 #define B_VEC_TRG(ACTION, ...)                                              \
@@ -19,6 +20,12 @@
     ACTION(sv<int32_t>,     gen_index,                  ## __VA_ARGS__)     \
     ACTION(sv<float>,       ele_weight,                 ## __VA_ARGS__)     \
 
+#define GETCOLUMN(type, var, name)                                          \
+    if (name == #var) {                                                     \
+        return [](etree const* t, int64_t i) -> double {                    \
+            return (*t->var)[i]; };                                         \
+    }                                                                       \
+
 class etree {
   public:
     etree(TTree* t, bool gen, bool hlt)
@@ -69,8 +76,27 @@ class etree {
     etree(bool gen, TTree* t)
         : etree(gen, false, t) { }
 
+    /* reader for a declared set of branches: all others are disabled, so
+     * reading an entry only decompresses the columns in use */
+    etree(bool gen, bool hlt, TTree* t,
+          std::vector<std::string> const& columns)
+            : etree(gen, hlt, t) {
+        t->SetBranchStatus("*", 0);
+        for (auto const& column : columns)
+            t->SetBranchStatus(column.data(), 1);
+    }
+
     ~etree() = default;
 
+    using accessor = double (*)(etree const*, int64_t);
+
+    /* per-electron column by branch name, nullptr if unknown */
+    static accessor column(std::string const& name) {
+        B_VEC_ELE_RECO(GETCOLUMN, name)
+
+        return nullptr;
+    }
+
     void clear() {
         B_VEC_ELE_RECO(CLEAROBJ)
 
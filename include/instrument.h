@@ -0,0 +1,287 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include "TFile.h"
+
+#include "../git/config/include/configurer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+/* run-time accounting of a job: time spent in each step of the event loop,
+ * event counts, peak memory and bytes read and written, written as json
+ * when the job ends. counts are atomic, so one instance is shared by all
+ * threads of a job */
+
+enum class step { io, selection, matching, id, fill, write, fit, nstep };
+enum class tally { read, skimmed, tagged, filled, ntally };
+
+class instrument {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /* charges the time since it was started, or since the last lap, to
+     * its current step, and the remainder when it goes out of scope. a
+     * single clock read per lap keeps it cheap enough for every event */
+    class timer {
+      public:
+        timer(instrument* owner, step s)
+                : _owner(owner),
+                  _step(s),
+                  _start(clock::now()) {
+        }
+
+        timer(timer&& other)
+                : _owner(other._owner),
+                  _step(other._step),
+                  _start(other._start) {
+            other._owner = nullptr;
+        }
+
+        timer(timer const&) = delete;
+        timer& operator=(timer const&) = delete;
+
+        ~timer() {
+            if (_owner) { _owner->add(_step, clock::now() - _start); }
+        }
+
+        void lap(step s) {
+            auto now = clock::now();
+            _owner->add(_step, now - _start);
+
+            _step = s;
+            _start = now;
+        }
+
+      private:
+        instrument* _owner;
+        step _step;
+        clock::time_point _start;
+    };
+
+    /* the report is written to path, or next to output if path is empty.
+     * a rate line is printed every interval seconds if interval is set */
+    instrument(std::string const& tool, std::string const& output,
+               std::string const& path, int64_t interval)
+            : _tool(tool),
+              _path(path.empty() ? report_for(output) : path),
+              _interval(interval * 1000000000LL),
+              _start(clock::now()),
+              _last(0),
+              _last_read(0) {
+        for (auto& nanoseconds : _nanoseconds) { nanoseconds = 0; }
+        for (auto& calls : _calls) { calls = 0; }
+        for (auto& count : _counts) { count = 0; }
+    }
+
+    /* the monitor of a tool, reported as set by report_path and
+     * report_interval in its configuration, counting bytes of root files */
+    instrument(configurer* conf, std::string const& tool,
+               std::string const& output)
+            : instrument(tool, output,
+                         conf->get<std::string>("report_path"),
+                         conf->get<int64_t>("report_interval")) {
+        bytes(TFile::GetFileBytesRead, TFile::GetFileBytesWritten);
+    }
+
+    ~instrument() {
+        if (!_path.empty()) { report(); }
+    }
+
+    /* events counted by one stage of a job that runs several on the same
+     * read, reported under its name. stages are added before the threads
+     * of the job start */
+    instrument& stage(std::string const& name) {
+        _stages.emplace_back(new instrument(name));
+        return *_stages.back();
+    }
+
+    timer time(step s) {
+        return timer(this, s);
+    }
+
+    void add(step s, clock::duration elapsed, int64_t calls = 1) {
+        auto i = static_cast<int32_t>(s);
+        _nanoseconds[i] += std::chrono::duration_cast<
+            std::chrono::nanoseconds>(elapsed).count();
+        _calls[i] += calls;
+    }
+
+    void count(tally t, int64_t n = 1) {
+        _counts[static_cast<int32_t>(t)] += n;
+
+        if (t == tally::read && _interval) { progress(); }
+    }
+
+    /* totals of bytes read and written by the job, taken at exit */
+    void bytes(std::function<int64_t()> read,
+               std::function<int64_t()> written) {
+        _bytes_read = read;
+        _bytes_written = written;
+    }
+
+    /* report name for an output: the output without its extension */
+    static std::string report_for(std::string output) {
+        auto ext = output.find(".root");
+        if (ext != std::string::npos)
+            output.erase(std::begin(output) + ext, std::end(output));
+
+        return output + ".json";
+    }
+
+    bool report() const {
+        FILE* f = fopen(_path.data(), "w");
+        if (!f) {
+            printf("failed to write report: %s\n", _path.data());
+            return false;
+        }
+
+        auto wall = seconds(clock::now() - _start);
+
+        struct rusage self;
+        struct rusage children;
+        getrusage(RUSAGE_SELF, &self);
+        getrusage(RUSAGE_CHILDREN, &children);
+
+        /* ru_maxrss is in kB on linux */
+        fprintf(f, "{\n");
+        fprintf(f, "  \"tool\": \"%s\",\n", _tool.data());
+        fprintf(f, "  \"wall_time\": %.3f,\n", wall);
+        fprintf(f, "  \"cpu_time\": %.3f,\n", seconds(self.ru_utime)
+            + seconds(self.ru_stime));
+        fprintf(f, "  \"peak_rss_mb\": %.1f,\n", self.ru_maxrss / 1024.);
+        fprintf(f, "  \"peak_rss_children_mb\": %.1f,\n",
+                children.ru_maxrss / 1024.);
+        fprintf(f, "  \"bytes_read\": %li,\n",
+                _bytes_read ? _bytes_read() : int64_t(0));
+        fprintf(f, "  \"bytes_written\": %li,\n",
+                _bytes_written ? _bytes_written() : int64_t(0));
+
+        auto read = _counts[static_cast<int32_t>(tally::read)].load();
+        fprintf(f, "  \"events_per_second\": %.1f,\n",
+                wall > 0. ? read / wall : 0.);
+
+        fprintf(f, "  \"events\": {\n");
+        for (int32_t i = 0; i < ntallies; ++i) {
+            fprintf(f, "    \"%s\": %li%s\n", name(static_cast<tally>(i)),
+                    _counts[i].load(), i + 1 < ntallies ? "," : "");
+        }
+        fprintf(f, "  },\n");
+
+        if (!_stages.empty()) {
+            fprintf(f, "  \"stages\": {\n");
+            for (std::size_t j = 0; j < _stages.size(); ++j) {
+                fprintf(f, "    \"%s\": {", _stages[j]->_tool.data());
+                for (int32_t i = 0; i < ntallies; ++i) {
+                    fprintf(f, " \"%s\": %li%s", name(static_cast<tally>(i)),
+                            _stages[j]->_counts[i].load(),
+                            i + 1 < ntallies ? "," : "");
+                }
+                fprintf(f, " }%s\n", j + 1 < _stages.size() ? "," : "");
+            }
+            fprintf(f, "  },\n");
+        }
+
+        /* share of the time in all steps, as steps of several threads
+         * overlap in wall time */
+        double total = 0.;
+        for (auto const& nanoseconds : _nanoseconds)
+            total += nanoseconds.load() / 1.e9;
+
+        fprintf(f, "  \"steps\": {\n");
+        for (int32_t i = 0; i < nsteps; ++i) {
+            auto time = _nanoseconds[i].load() / 1.e9;
+            fprintf(f, "    \"%s\": { \"time\": %.3f, \"calls\": %li, "
+                    "\"share\": %.4f }%s\n", name(static_cast<step>(i)),
+                    time, _calls[i].load(), total > 0. ? time / total : 0.,
+                    i + 1 < nsteps ? "," : "");
+        }
+        fprintf(f, "  }\n");
+        fprintf(f, "}\n");
+
+        fclose(f);
+
+        return true;
+    }
+
+  private:
+    /* counts only, reported by the job that owns it */
+    explicit instrument(std::string const& stage)
+            : _tool(stage),
+              _interval(0),
+              _start(clock::now()),
+              _last(0),
+              _last_read(0) {
+        for (auto& nanoseconds : _nanoseconds) { nanoseconds = 0; }
+        for (auto& calls : _calls) { calls = 0; }
+        for (auto& count : _counts) { count = 0; }
+    }
+
+    static constexpr int32_t nsteps = static_cast<int32_t>(step::nstep);
+    static constexpr int32_t ntallies = static_cast<int32_t>(tally::ntally);
+
+    static char const* name(step s) {
+        static char const* const names[] = { "io", "selection", "matching",
+            "id", "fill", "write", "fit" };
+        return names[static_cast<int32_t>(s)];
+    }
+
+    static char const* name(tally t) {
+        static char const* const names[] = { "read", "skimmed", "tagged",
+            "filled" };
+        return names[static_cast<int32_t>(t)];
+    }
+
+    static double seconds(clock::duration elapsed) {
+        return std::chrono::duration<double>(elapsed).count();
+    }
+
+    static double seconds(struct timeval const& tv) {
+        return tv.tv_sec + tv.tv_usec / 1.e6;
+    }
+
+    /* one thread prints once the interval has passed since the last line */
+    void progress() {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now() - _start).count();
+
+        auto last = _last.load();
+        if (elapsed - last < _interval) { return; }
+        if (!_last.compare_exchange_strong(last, elapsed)) { return; }
+
+        auto read = _counts[static_cast<int32_t>(tally::read)].load();
+        auto previous = _last_read.exchange(read);
+
+        printf("%s: %li events, %.0f events/s (%.0f events/s overall)\n",
+               _tool.data(), read, (read - previous) / ((elapsed - last)
+               / 1.e9), read / (elapsed / 1.e9));
+    }
+
+    std::string _tool;
+    std::string _path;
+    int64_t _interval;
+    clock::time_point _start;
+
+    std::atomic<int64_t> _nanoseconds[nsteps];
+    std::atomic<int64_t> _calls[nsteps];
+    std::atomic<int64_t> _counts[ntallies];
+
+    std::atomic<int64_t> _last;
+    std::atomic<int64_t> _last_read;
+
+    std::function<int64_t()> _bytes_read;
+    std::function<int64_t()> _bytes_written;
+
+    std::vector<std::unique_ptr<instrument>> _stages;
+};
+
+#endif /* INSTRUMENT_H */
@@ -0,0 +1,60 @@
+#ifndef KEYED_RANDOM_H
+#define KEYED_RANDOM_H
+
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+
+/* counter-based random numbers: each draw is a pure function of the seed
+ * and a key, e.g. (entry, electron, electron, leg), so results do not
+ * depend on the order in which entries are processed */
+
+class keyed_random {
+  public:
+    keyed_random(uint64_t seed)
+        : _seed(seed) { }
+
+    ~keyed_random() = default;
+
+    /* uniform in (0, 1] */
+    double uniform(uint64_t a, uint64_t b, uint64_t c, uint64_t d) const {
+        return to_unit(hash(a, b, c, d));
+    }
+
+    double gaus(double mean, double sigma,
+                uint64_t a, uint64_t b, uint64_t c, uint64_t d) const {
+        auto h = hash(a, b, c, d);
+
+        /* box-muller from two independent streams of the same key */
+        double u1 = to_unit(h);
+        double u2 = to_unit(mix(h + 0x9e3779b97f4a7c15ULL));
+
+        constexpr double tau = 6.283185307179586;
+        return mean + sigma * std::sqrt(-2. * std::log(u1))
+            * std::cos(tau * u2);
+    }
+
+  private:
+    /* splitmix64 finaliser */
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t hash(uint64_t a, uint64_t b, uint64_t c, uint64_t d) const {
+        auto h = mix(_seed + 0x9e3779b97f4a7c15ULL);
+        for (auto v : { a, b, c, d })
+            h = mix(h ^ mix(v + 0x9e3779b97f4a7c15ULL));
+
+        return h;
+    }
+
+    static double to_unit(uint64_t h) {
+        return ((h >> 11) + 1) / 9007199254740992.;
+    }
+
+    uint64_t _seed;
+};
+
+#endif /* KEYED_RANDOM_H */
@@ -0,0 +1,206 @@
+#ifndef LOOKUP_H
+#define LOOKUP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/* n-dimensional binned values in a flat array, laid out as in root with an
+ * underflow and overflow bin on every axis (bin 0 and bin n + 1) and the
+ * first axis running fastest. bins are found without virtual calls, in
+ * constant time for uniform axes and by binary search otherwise */
+
+class lookup {
+  public:
+    lookup() = default;
+
+    lookup(std::vector<std::string> const& variables,
+           std::vector<std::vector<double>> const& edges)
+            : _variables(variables),
+              _edges(edges) {
+        int64_t size = 1;
+        for (auto const& axis : _edges) {
+            _strides.push_back(size);
+            size *= static_cast<int64_t>(axis.size()) + 1;
+
+            auto nbins = static_cast<double>(axis.size() - 1);
+            auto width = (axis.back() - axis.front()) / nbins;
+
+            bool uniform = true;
+            for (std::size_t i = 1; i < axis.size(); ++i)
+                if (std::abs(axis[i] - axis[i - 1] - width) > 1.e-6 * width)
+                    uniform = false;
+
+            _scales.push_back(uniform ? 1. / width : 0.);
+        }
+
+        _values.assign(size, 0.f);
+        _errors.assign(size, 0.f);
+    }
+
+    ~lookup() = default;
+
+    int64_t dimensions() const {
+        return static_cast<int64_t>(_edges.size());
+    }
+
+    int64_t size() const {
+        return static_cast<int64_t>(_values.size());
+    }
+
+    std::vector<std::string> const& variables() const { return _variables; }
+    std::vector<double> const& edges(int64_t d) const { return _edges[d]; }
+
+    std::vector<float>& values() { return _values; }
+    std::vector<float> const& values() const { return _values; }
+    std::vector<float>& errors() { return _errors; }
+    std::vector<float> const& errors() const { return _errors; }
+
+    /* bin along axis d, as TAxis::FindBin */
+    int64_t bin(int64_t d, double x) const {
+        auto const& axis = _edges[d];
+        auto nbins = static_cast<int64_t>(axis.size()) - 1;
+
+        if (x < axis.front()) { return 0; }
+        if (!(x < axis.back())) { return nbins + 1; }
+
+        if (_scales[d] != 0.) {
+            /* guess from the width, then correct for rounding at edges */
+            auto b = static_cast<int64_t>((x - axis.front()) * _scales[d]);
+            b = std::min(b, nbins - 1);
+
+            if (x < axis[b]) { --b; }
+            else if (!(x < axis[b + 1])) { ++b; }
+
+            return b + 1;
+        }
+
+        return std::upper_bound(std::begin(axis), std::end(axis), x)
+            - std::begin(axis);
+    }
+
+    /* flat index of a point, given one coordinate per axis */
+    template <typename T>
+    int64_t index(T const* x) const {
+        int64_t index = 0;
+        for (int64_t d = 0; d < dimensions(); ++d)
+            index += bin(d, x[d]) * _strides[d];
+
+        return index;
+    }
+
+    /* bin along every axis of a flat index */
+    std::vector<int64_t> bins(int64_t index) const {
+        std::vector<int64_t> bins(dimensions());
+        for (int64_t d = dimensions() - 1; d >= 0; --d) {
+            bins[d] = index / _strides[d];
+            index -= bins[d] * _strides[d];
+        }
+
+        return bins;
+    }
+
+    /* index of the nearest bin inside the range of every axis, moving
+     * underflow and overflow into the first and last bins */
+    int64_t clamp(int64_t index) const {
+        auto b = bins(index);
+
+        int64_t clamped = 0;
+        for (int64_t d = 0; d < dimensions(); ++d) {
+            auto nbins = static_cast<int64_t>(_edges[d].size()) - 1;
+            b[d] = std::max(std::min(b[d], nbins), int64_t(1));
+            clamped += b[d] * _strides[d];
+        }
+
+        return clamped;
+    }
+
+    template <typename T>
+    float operator()(T const* x) const {
+        return _values[index(x)];
+    }
+
+    /* values for count points, given one column (indexable by point) per
+     * axis, appended to out */
+    template <typename T>
+    void evaluate(int64_t count, std::vector<T> const& columns,
+                  std::vector<float>& out) const {
+        std::vector<int64_t> indices(count, 0);
+        for (int64_t d = 0; d < dimensions(); ++d)
+            for (int64_t i = 0; i < count; ++i)
+                indices[i] += bin(d, columns[d](i)) * _strides[d];
+
+        for (auto index : indices)
+            out.push_back(_values[index]);
+    }
+
+    /* stored as plain vectors next to each other, under a common prefix */
+    template <typename T>
+    void write(T* directory, std::string const& name) const {
+        std::vector<int32_t> shape;
+        std::vector<double> edges;
+        for (auto const& axis : _edges) {
+            shape.push_back(static_cast<int32_t>(axis.size()));
+            edges.insert(std::end(edges), std::begin(axis), std::end(axis));
+        }
+
+        directory->WriteObject(&_variables, (name + "_variables").data());
+        directory->WriteObject(&shape, (name + "_shape").data());
+        directory->WriteObject(&edges, (name + "_edges").data());
+        directory->WriteObject(&_values, (name + "_values").data());
+        directory->WriteObject(&_errors, (name + "_errors").data());
+    }
+
+    /* false if not found, e.g. for weights written before the lookup */
+    template <typename T>
+    bool read(T* directory, std::string const& name) {
+        std::vector<std::string>* variables = nullptr;
+        std::vector<int32_t>* shape = nullptr;
+        std::vector<double>* edges = nullptr;
+        std::vector<float>* values = nullptr;
+        std::vector<float>* errors = nullptr;
+
+        directory->GetObject((name + "_variables").data(), variables);
+        directory->GetObject((name + "_shape").data(), shape);
+        directory->GetObject((name + "_edges").data(), edges);
+        directory->GetObject((name + "_values").data(), values);
+        directory->GetObject((name + "_errors").data(), errors);
+
+        bool found = variables && shape && edges && values && errors;
+
+        if (found) {
+            std::vector<std::vector<double>> axes;
+            auto start = std::begin(*edges);
+            for (auto count : *shape) {
+                axes.emplace_back(start, start + count);
+                start += count;
+            }
+
+            *this = lookup(*variables, axes);
+            _values = *values;
+            _errors = *errors;
+        }
+
+        delete variables;
+        delete shape;
+        delete edges;
+        delete values;
+        delete errors;
+
+        return found;
+    }
+
+  private:
+    std::vector<std::string> _variables;
+    std::vector<std::vector<double>> _edges;
+    std::vector<int64_t> _strides;
+    std::vector<double> _scales;
+
+    std::vector<float> _values;
+    std::vector<float> _errors;
+};
+
+#endif /* LOOKUP_H */
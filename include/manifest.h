@@ -0,0 +1,162 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* sidecar record of input files already processed by a resumable job.
+ * each line holds the chunk index, the number of entries processed, the
+ * number of entries in the input file, a hash of the settings the chunk
+ * was written with and the input file, and is appended only after the
+ * chunk has been closed. a file cut short by max_entries is recorded with
+ * fewer entries than it has, so that it is processed again if more entries
+ * are wanted later. records written with other settings are ignored, so
+ * their files are processed again */
+
+class manifest {
+  public:
+    manifest(std::string const& output, std::string const& settings)
+            : _stem(output),
+              _hash(hash(settings)),
+              _next(0) {
+        auto ext = _stem.find(".root");
+        if (ext != std::string::npos)
+            _stem.erase(std::begin(_stem) + ext, std::end(_stem));
+
+        load();
+    }
+
+    ~manifest() = default;
+
+    bool committed(std::string const& file) const {
+        return _records.find(file) != std::end(_records);
+    }
+
+    /* committed with the entries wanted, or all of them if 0 */
+    bool done(std::string const& file, int64_t wanted = 0) const {
+        auto it = _records.find(file);
+        if (it == std::end(_records)) { return false; }
+
+        auto const& r = it->second;
+        return r.entries == (wanted ? wanted : r.total);
+    }
+
+    int64_t entries(std::string const& file) const {
+        return _records.at(file).entries;
+    }
+
+    int64_t total(std::string const& file) const {
+        return _records.at(file).total;
+    }
+
+    /* reserve a chunk index that does not clash with committed chunks */
+    int64_t reserve() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _next++;
+    }
+
+    std::string chunk(int64_t index) const {
+        return _stem + ".chunk" + std::to_string(index) + ".root";
+    }
+
+    std::string chunk(std::string const& file) const {
+        return chunk(_records.at(file).index);
+    }
+
+    /* false if the record could not be written, leaving the file to be
+     * processed again */
+    bool commit(std::string const& file, int64_t index, int64_t entries,
+                int64_t total) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        FILE* f = fopen(path().data(), "a");
+        if (!f) {
+            printf("failed to write manifest: %s\n", path().data());
+            return false;
+        }
+
+        fprintf(f, "%li %li %li %s %s\n", index, entries, total,
+                _hash.data(), file.data());
+        if (fclose(f)) {
+            printf("failed to write manifest: %s\n", path().data());
+            return false;
+        }
+
+        _records[file] = { index, entries, total };
+
+        return true;
+    }
+
+    /* records are keyed by input file, so each may be listed once */
+    static bool distinct(std::vector<std::string> const& files) {
+        std::set<std::string> seen;
+        for (auto const& file : files) {
+            if (!seen.insert(file).second) {
+                printf("file listed twice: %s\n", file.data());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+  private:
+    struct record {
+        int64_t index;
+        int64_t entries;
+        int64_t total;
+    };
+
+    std::string path() const {
+        return _stem + ".manifest";
+    }
+
+    static std::string hash(std::string const& settings) {
+        char digest[17];
+        snprintf(digest, sizeof(digest), "%016zx",
+                 std::hash<std::string>()(settings));
+
+        return digest;
+    }
+
+    void load() {
+        std::ifstream f(path());
+
+        std::string line;
+        while (std::getline(f, line)) {
+            std::istringstream ss(line);
+
+            int64_t index;
+            int64_t entries;
+            int64_t total;
+            std::string hash;
+            std::string file;
+            if (!(ss >> index >> entries >> total >> hash >> file))
+                continue;
+
+            /* chunks of other settings are never reused, nor overwritten */
+            _next = std::max(_next, index + 1);
+            if (hash != _hash) { continue; }
+
+            _records[file] = { index, entries, total };
+        }
+    }
+
+    std::string _stem;
+    std::string _hash;
+    int64_t _next;
+
+    std::map<std::string, record> _records;
+
+    std::mutex _mutex;
+};
+
+#endif /* MANIFEST_H */
@@ -0,0 +1,272 @@
+#ifndef MATCHING_H
+#define MATCHING_H
+
+#include "../git/tricks-and-treats/include/overflow_angles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+inline float oadphi(float phi1, float phi2) {
+    return revert_radian(convert_radian(phi1) - convert_radian(phi2));
+}
+
+/* indices of objects passing the final filter step, i.e. values repeated
+ * exactly size times (once per filter step), in order of first appearance.
+ * a nan is equal to nothing, not even itself, so it never passes, and is
+ * left out before sorting */
+template <typename T>
+std::vector<int64_t> final_filter(std::vector<T> const& values, int64_t size) {
+    auto count = static_cast<int64_t>(values.size());
+
+    std::vector<int64_t> order;
+    order.reserve(count);
+    for (int64_t i = 0; i < count; ++i)
+        if (!std::isnan(values[i])) { order.push_back(i); }
+
+    std::stable_sort(std::begin(order), std::end(order),
+        [&](int64_t a, int64_t b) { return values[a] < values[b]; });
+
+    auto nordered = static_cast<int64_t>(order.size());
+
+    std::vector<int64_t> indices;
+    for (int64_t i = 0; i < nordered;) {
+        int64_t j = i + 1;
+        while (j < nordered && values[order[j]] == values[order[i]]) { ++j; }
+
+        /* stable sort: first index of each run is the first appearance */
+        if (j - i == size) { indices.push_back(order[i]); }
+
+        i = j;
+    }
+
+    std::sort(std::begin(indices), std::end(indices));
+
+    return indices;
+}
+
+/* trigger objects above threshold, sorted by eta */
+class trigger_objects {
+  public:
+    template <typename T, typename U, typename V>
+    trigger_objects(float threshold, std::vector<T> const& pt,
+            std::vector<U> const& eta, std::vector<V> const& phi,
+            std::vector<int64_t> const& indices) {
+        /* an object with nan eta is never nearest, and would break the
+         * ordering, so it is left out */
+        std::vector<int64_t> selected;
+        for (auto index : indices)
+            if (!(static_cast<float>(pt[index]) < threshold)
+                    && !std::isnan(static_cast<float>(eta[index])))
+                selected.push_back(index);
+
+        std::stable_sort(std::begin(selected), std::end(selected),
+            [&](int64_t a, int64_t b) {
+                return static_cast<float>(eta[a])
+                    < static_cast<float>(eta[b]); });
+
+        for (auto index : selected) {
+            _eta.push_back(eta[index]);
+            _phi.push_back(phi[index]);
+        }
+    }
+
+    template <typename T, typename U, typename V>
+    trigger_objects(float threshold, std::vector<T> const& pt,
+            std::vector<U> const& eta, std::vector<V> const& phi)
+        : trigger_objects(threshold, pt, eta, phi, all(pt.size())) { }
+
+    ~trigger_objects() = default;
+
+    /* minimum dr^2 to any object, scanning outwards in eta until the eta
+     * separation alone exceeds the best match */
+    float nearest(float eta, float phi) const {
+        float mindr2 = 999.f;
+
+        auto count = static_cast<int64_t>(_eta.size());
+        auto start = std::lower_bound(std::begin(_eta), std::end(_eta), eta)
+            - std::begin(_eta);
+
+        auto test = [&](int64_t i) {
+            float deta = eta - _eta[i];
+            if (deta * deta >= mindr2) { return false; }
+
+            float dphi = oadphi(phi, _phi[i]);
+            float dr2 = deta * deta + dphi * dphi;
+
+            if (dr2 < mindr2) { mindr2 = dr2; }
+            return true;
+        };
+
+        for (int64_t i = start; i < count && test(i); ++i);
+        for (int64_t i = start - 1; i >= 0 && test(i); --i);
+
+        return mindr2;
+    }
+
+    template <typename T, typename U>
+    std::vector<float> nearest(std::vector<T> const& eta,
+                               std::vector<U> const& phi) const {
+        std::vector<float> mindr2;
+        mindr2.reserve(eta.size());
+
+        auto count = static_cast<int64_t>(eta.size());
+        for (int64_t i = 0; i < count; ++i)
+            mindr2.push_back(nearest(eta[i], phi[i]));
+
+        return mindr2;
+    }
+
+  private:
+    static std::vector<int64_t> all(std::size_t size) {
+        std::vector<int64_t> indices(size);
+        std::iota(std::begin(indices), std::end(indices), 0);
+        return indices;
+    }
+
+    std::vector<float> _eta;
+    std::vector<float> _phi;
+};
+
+/* indices of final state particles of the given type, either charge */
+template <typename T, typename U>
+std::vector<int64_t> final_state(std::vector<T> const& pid,
+        std::vector<U> const& status, int32_t type) {
+    std::vector<int64_t> indices;
+
+    auto count = static_cast<int64_t>(pid.size());
+    for (int64_t i = 0; i < count; ++i)
+        if (std::abs(pid[i]) == type && status[i] == 1)
+            indices.push_back(i);
+
+    return indices;
+}
+
+/* generator level objects, sorted by eta, matched by highest pt */
+class gen_objects {
+  public:
+    template <typename T, typename U, typename V>
+    gen_objects(std::vector<T> const& pt, std::vector<U> const& eta,
+            std::vector<V> const& phi, std::vector<int64_t> const& indices)
+            : _unordered(false) {
+        /* an object with nan eta is never within the cone, and would break
+         * the ordering, so it is left out */
+        std::vector<int64_t> selected;
+        for (auto index : indices)
+            if (!std::isnan(static_cast<float>(eta[index])))
+                selected.push_back(index);
+
+        std::stable_sort(std::begin(selected), std::end(selected),
+            [&](int64_t a, int64_t b) {
+                return static_cast<float>(eta[a])
+                    < static_cast<float>(eta[b]); });
+
+        for (auto index : selected) {
+            _pt.push_back(pt[index]);
+            _eta.push_back(eta[index]);
+            _phi.push_back(phi[index]);
+            _index.push_back(index);
+
+            if (std::isnan(static_cast<float>(pt[index])))
+                _unordered = true;
+        }
+
+        /* a nan pt, once matched, lets any later object in the cone take
+         * over, which depends on the original order: such events are
+         * scanned in that order */
+        if (_unordered) {
+            _order.resize(_index.size());
+            std::iota(std::begin(_order), std::end(_order), 0);
+            std::sort(std::begin(_order), std::end(_order),
+                [&](int64_t a, int64_t b) { return _index[a] < _index[b]; });
+        }
+    }
+
+    ~gen_objects() = default;
+
+    /* index of the highest pt object within dr^2 < max_dr2, the last one
+     * in the original order for equal pt, or -1. only objects in the eta
+     * window around the given eta are visited */
+    int32_t match(float eta, float phi, float max_dr2) const {
+        if (_unordered) { return scan(eta, phi, max_dr2); }
+
+        int32_t match = -1;
+        float maxpt = -1;
+
+        auto count = static_cast<int64_t>(_eta.size());
+        auto start = std::lower_bound(std::begin(_eta), std::end(_eta), eta)
+            - std::begin(_eta);
+
+        auto test = [&](int64_t i) {
+            float deta = eta - _eta[i];
+            if (deta * deta >= max_dr2) { return false; }
+
+            if (_pt[i] < maxpt) { return true; }
+            if (_pt[i] == maxpt && _index[i] < match) { return true; }
+
+            float dphi = oadphi(phi, _phi[i]);
+            float dr2 = dphi * dphi + deta * deta;
+
+            if (dr2 < max_dr2) {
+                maxpt = _pt[i];
+                match = _index[i];
+            }
+
+            return true;
+        };
+
+        for (int64_t i = start; i < count && test(i); ++i);
+        for (int64_t i = start - 1; i >= 0 && test(i); --i);
+
+        return match;
+    }
+
+    template <typename T, typename U>
+    std::vector<int32_t> match(std::vector<T> const& eta,
+                               std::vector<U> const& phi,
+                               float max_dr2) const {
+        std::vector<int32_t> indices;
+        indices.reserve(eta.size());
+
+        auto count = static_cast<int64_t>(eta.size());
+        for (int64_t i = 0; i < count; ++i)
+            indices.push_back(match(eta[i], phi[i], max_dr2));
+
+        return indices;
+    }
+
+  private:
+    int32_t scan(float eta, float phi, float max_dr2) const {
+        int32_t match = -1;
+        float maxpt = -1;
+
+        for (auto i : _order) {
+            if (_pt[i] < maxpt) { continue; }
+
+            float deta = eta - _eta[i];
+            float dphi = oadphi(phi, _phi[i]);
+            float dr2 = dphi * dphi + deta * deta;
+
+            if (dr2 < max_dr2) {
+                maxpt = _pt[i];
+                match = _index[i];
+            }
+        }
+
+        return match;
+    }
+
+    std::vector<float> _pt;
+    std::vector<float> _eta;
+    std::vector<float> _phi;
+    std::vector<int32_t> _index;
+
+    bool _unordered;
+    std::vector<int64_t> _order;
+};
+
+#endif /* MATCHING_H */
@@ -0,0 +1,58 @@
+#ifndef PAIRTREE_H
+#define PAIRTREE_H
+
+#include "../git/foliage/include/foliage.h"
+
+#include "TTree.h"
+
+#include <vector>
+
+#define B_VAL_PAIR(ACTION, ...)                                             \
+    ACTION(int64_t,         entry,                      ## __VA_ARGS__)     \
+    ACTION(int32_t,         index1,                     ## __VA_ARGS__)     \
+    ACTION(int32_t,         index2,                     ## __VA_ARGS__)     \
+    ACTION(float,           pt1,                        ## __VA_ARGS__)     \
+    ACTION(float,           eta1,                       ## __VA_ARGS__)     \
+    ACTION(float,           phi1,                       ## __VA_ARGS__)     \
+    ACTION(float,           pt2,                        ## __VA_ARGS__)     \
+    ACTION(float,           eta2,                       ## __VA_ARGS__)     \
+    ACTION(float,           phi2,                       ## __VA_ARGS__)     \
+    ACTION(int32_t,         endcap1,                    ## __VA_ARGS__)     \
+    ACTION(int32_t,         endcap2,                    ## __VA_ARGS__)     \
+    ACTION(int32_t,         cent,                       ## __VA_ARGS__)     \
+    ACTION(int32_t,         charge,                     ## __VA_ARGS__)     \
+    ACTION(float,           weight,                     ## __VA_ARGS__)     \
+
+#define STOREVAL(type, var, obj)    obj->var = var;
+
+/* selected electron pair, independent of energy scale and smearing */
+struct dielectron {
+    B_VAL_PAIR(DECLVAL)
+};
+
+class pairtree {
+  public:
+    pairtree(TTree* t, bool read) {
+        if (read) {
+            B_VAL_PAIR(SETZERO)
+            B_VAL_PAIR(SETVALADDR, t)
+        } else {
+            B_VAL_PAIR(SETMONE)
+            B_VAL_PAIR(BRANCHVAL, t)
+        }
+    }
+
+    ~pairtree() = default;
+
+    void copy(dielectron* p) {
+        B_VAL_PAIR(COPYVAL, p)
+    }
+
+    void store(dielectron* p) const {
+        B_VAL_PAIR(STOREVAL, p)
+    }
+
+    B_VAL_PAIR(DECLVAL)
+};
+
+#endif /* PAIRTREE_H */
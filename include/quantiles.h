@@ -0,0 +1,141 @@
+#ifndef QUANTILES_H
+#define QUANTILES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+
+/* streaming quantile estimate with bounded memory. values are kept exactly
+ * up to a limit, beyond which they are compacted into a kll sketch: levels
+ * of buffers, where each item at level h stands for 2^h values. the top
+ * level holds k items and each level below 2/3 of the one above, at least
+ * 2. once the sketch is over its total capacity, the lowest full level is
+ * sorted and every other item promoted to the next level */
+
+class quantiles {
+  public:
+    quantiles(int64_t k, int64_t exact)
+            : _k(k),
+              _exact(exact),
+              _count(0),
+              _size(0),
+              _limit(k),
+              _levels(1),
+              _capacities(1, k),
+              _coin(144) {
+    }
+
+    ~quantiles() = default;
+
+    void fill(double value) {
+        _levels[0].push_back(value);
+        ++_count;
+        ++_size;
+
+        if (exact()) { return; }
+
+        while (_size > _limit) {
+            /* over total capacity, so some level is full */
+            std::size_t h = 0;
+            while (static_cast<int64_t>(_levels[h].size()) < _capacities[h])
+                ++h;
+
+            compact(h);
+        }
+    }
+
+    int64_t count() const {
+        return _count;
+    }
+
+    bool exact() const {
+        return _levels.size() == 1 && _count <= _exact;
+    }
+
+    /* value at rank q * count in sorted order, as values[q * count] */
+    double quantile(double q) {
+        if (!_count) { return 0.; }
+
+        auto rank = static_cast<int64_t>(q * _count);
+        rank = std::max(std::min(rank, _count - 1), int64_t(0));
+
+        if (exact()) {
+            auto& values = _levels[0];
+            std::nth_element(std::begin(values), std::begin(values) + rank,
+                             std::end(values));
+            return values[rank];
+        }
+
+        std::vector<std::pair<double, int64_t>> items;
+        for (std::size_t h = 0; h < _levels.size(); ++h)
+            for (auto value : _levels[h])
+                items.emplace_back(value, int64_t(1) << h);
+
+        std::sort(std::begin(items), std::end(items));
+
+        int64_t sum = 0;
+        for (auto const& item : items) {
+            sum += item.second;
+            if (sum > rank) { return item.first; }
+        }
+
+        return items.back().first;
+    }
+
+  private:
+    void compact(std::size_t h) {
+        if (h + 1 == _levels.size()) {
+            _levels.emplace_back();
+
+            /* capacities shrink with the distance from the top level */
+            auto nlevels = _levels.size();
+            _capacities.resize(nlevels);
+            _limit = 0;
+            for (std::size_t i = 0; i < nlevels; ++i) {
+                auto depth = static_cast<double>(nlevels - 1 - i);
+                auto size = static_cast<int64_t>(
+                    std::ceil(_k * std::pow(2. / 3., depth)));
+
+                _capacities[i] = std::max(size, int64_t(2));
+                _limit += _capacities[i];
+            }
+        }
+
+        auto& level = _levels[h];
+        std::sort(std::begin(level), std::end(level));
+
+        /* pick which half is kept at random to avoid a systematic
+         * bias, with a fixed seed so results are reproducible */
+        std::size_t offset = _coin() & 1;
+
+        auto size = level.size() & ~std::size_t(1);
+        for (std::size_t i = offset; i < size; i += 2)
+            _levels[h + 1].push_back(level[i]);
+
+        /* an odd item out stays at this level */
+        if (level.size() > size) {
+            level[0] = level.back();
+            level.resize(1);
+        } else {
+            level.clear();
+        }
+
+        _size -= size / 2;
+    }
+
+    int64_t _k;
+    int64_t _exact;
+    int64_t _count;
+    int64_t _size;
+    int64_t _limit;
+
+    std::vector<std::vector<double>> _levels;
+    std::vector<int64_t> _capacities;
+    std::mt19937 _coin;
+};
+
+#endif /* QUANTILES_H */
@@ -0,0 +1,277 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "TBranch.h"
+#include "TEnv.h"
+#include "TFile.h"
+#include "TFileCacheRead.h"
+#include "TLeaf.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeCacheUnzip.h"
+#include "TUrl.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/* read-ahead through the tree cache: the baskets of the active branches of
+ * a tree are read in one request per cache block, the next block fetched
+ * by the prefetching thread of the file while the loop works on the
+ * current one, and unzipped on a pool of io threads. reads go through the
+ * file of the tree, so bytes are read once and counted once */
+
+/* prefetching and unzipping modes are global and taken when a cache is
+ * created, so they are set once, before any tree is read */
+inline void enable_readahead(int64_t nthreads) {
+    ROOT::EnableThreadSafety();
+    gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
+    if (nthreads < 1) { return; }
+
+    ROOT::EnableImplicitMT(nthreads);
+    TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+}
+
+/* cache of size MB for entries [first, last) of each tree, set up after
+ * its branches are activated and before the first entry is read */
+inline void readahead(std::vector<TTree*> const& trees, int64_t first,
+                      int64_t last, int64_t size) {
+    if (size < 1) { return; }
+
+    for (auto t : trees) {
+        if (!t) { continue; }
+
+        t->SetCacheSize(size << 20);
+        t->LoadTree(first);
+        t->SetCacheEntryRange(first, last);
+
+        /* branches are known up front, so no learning phase is needed */
+        std::set<std::string> names;
+        for (auto leaf : *t->GetListOfLeaves()) {
+            auto branch = static_cast<TLeaf*>(leaf)->GetBranch();
+            if (t->GetBranchStatus(branch->GetName()))
+                names.insert(branch->GetName());
+        }
+
+        for (auto const& name : names)
+            t->AddBranchToCache(name.data(), true);
+
+        t->StopCacheLearningPhase();
+    }
+}
+
+/* the asynchronous prefetching of the tree cache is switched off by ROOT
+ * for local paths, mounted network storage included, so there each cache
+ * refill blocks the loop. for such files the baskets of the next depth
+ * clusters of each tree are handed to a reader thread, which has the
+ * kernel read them into the page cache (posix_fadvise). the refill is then
+ * served from memory, and bytes still go through the file of the tree
+ * once, as counted in bytes_read. the loop calls the prefetcher after each
+ * entry it reads; plans are made on the loop's thread, from the baskets of
+ * the current file only, so nothing is opened ahead of the loop */
+class prefetcher {
+  public:
+    prefetcher(std::vector<TTree*> const& trees, int64_t depth)
+            : _depth(depth),
+              _stop(false) {
+        if (_depth < 1) { return; }
+
+        for (auto t : trees)
+            if (t) { _trees.emplace_back(t); }
+
+        _reader = std::thread(&prefetcher::work, this);
+    }
+
+    prefetcher(prefetcher const&) = delete;
+    prefetcher& operator=(prefetcher const&) = delete;
+
+    ~prefetcher() {
+        if (_depth < 1) { return; }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+
+        _wake.notify_one();
+        _reader.join();
+
+        for (auto const& fd : _fds) { ::close(fd.second); }
+    }
+
+    void operator()() {
+        if (_depth < 1) { return; }
+
+        for (auto& s : _trees) { plan(s); }
+    }
+
+  private:
+    struct source {
+        explicit source(TTree* chain)
+            : chain(chain), tree(nullptr), local(false), next(0), end(0) { }
+
+        TTree* chain;
+        TTree* tree;
+        bool local;
+        std::string path;
+        std::vector<TBranch*> branches;
+        int64_t next;
+        int64_t end;
+    };
+
+    struct request {
+        std::string path;
+        std::vector<std::pair<int64_t, int64_t>> ranges;
+    };
+
+    void plan(source& s) {
+        auto tree = s.chain->GetTree();
+        if (!tree) { return; }
+
+        if (tree != s.tree) { attach(s, tree); }
+        if (!s.local) { return; }
+
+        /* once per cluster: ask for the clusters up to depth ahead */
+        int64_t entry = tree->GetReadEntry();
+        if (entry < s.next) { return; }
+
+        int64_t nentries = tree->GetEntries();
+        auto clusters = tree->GetClusterIterator(entry);
+        clusters();
+        s.next = clusters.GetNextEntry();
+
+        int64_t last = s.next;
+        for (int64_t k = 0; k < _depth && clusters() < nentries; ++k)
+            last = clusters.GetNextEntry();
+
+        int64_t first = std::max(s.next, s.end);
+        if (last <= first) { return; }
+
+        s.end = last;
+
+        request job;
+        job.path = s.path;
+        for (auto branch : s.branches) {
+            auto nbaskets = branch->GetWriteBasket();
+            auto entries = branch->GetBasketEntry();
+            auto seeks = branch->GetBasketSeek();
+            auto bytes = branch->GetBasketBytes();
+
+            /* first basket holding entry first */
+            auto j = std::upper_bound(entries, entries + nbaskets, first)
+                - entries - 1;
+            for (j = std::max(j, decltype(j)(0)); j < nbaskets; ++j) {
+                if (entries[j] >= last) { break; }
+                if (seeks[j]) { job.ranges.emplace_back(seeks[j], bytes[j]); }
+            }
+        }
+
+        if (job.ranges.empty()) { return; }
+
+        /* bounded: a plan is dropped, not waited for, if the reader is
+         * that far behind, as the loop then reads the baskets itself */
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (static_cast<int64_t>(_queue.size())
+                    >= _depth * static_cast<int64_t>(_trees.size()))
+                return;
+
+            _queue.push_back(std::move(job));
+        }
+
+        _wake.notify_one();
+    }
+
+    /* a new file: prefetch only if the cache of the tree cannot */
+    void attach(source& s, TTree* tree) {
+        s.tree = tree;
+        s.next = 0;
+        s.end = 0;
+        s.branches.clear();
+
+        auto file = tree->GetCurrentFile();
+        auto cache = file ? tree->GetReadCache(file) : nullptr;
+        s.local = file && !(cache && cache->IsEnablePrefetching());
+        if (!s.local) { return; }
+
+        s.path = file->GetEndpointUrl()->GetFile();
+
+        std::set<TBranch*> branches;
+        for (auto leaf : *tree->GetListOfLeaves()) {
+            auto branch = static_cast<TLeaf*>(leaf)->GetBranch();
+            if (tree->GetBranchStatus(branch->GetName()))
+                branches.insert(branch);
+        }
+
+        s.branches.assign(std::begin(branches), std::end(branches));
+    }
+
+    void work() {
+        for (;;) {
+            request job;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _stop || !_queue.empty(); });
+                if (_stop) { return; }
+
+                job = std::move(_queue.front());
+                _queue.pop_front();
+            }
+
+            auto it = _fds.find(job.path);
+            if (it == std::end(_fds)) {
+                int fd = ::open(job.path.data(), O_RDONLY);
+                if (fd < 0) { continue; }
+
+                it = _fds.emplace(job.path, fd).first;
+            }
+
+            /* baskets of a cluster are mostly contiguous: one advice per
+             * run of adjacent baskets */
+            auto& ranges = job.ranges;
+            std::sort(std::begin(ranges), std::end(ranges));
+
+            int64_t offset = ranges.front().first;
+            int64_t end = offset + ranges.front().second;
+            for (auto const& range : ranges) {
+                if (range.first > end) {
+                    posix_fadvise(it->second, offset, end - offset,
+                                  POSIX_FADV_WILLNEED);
+                    offset = range.first;
+                }
+
+                end = std::max(end, range.first + range.second);
+            }
+
+            posix_fadvise(it->second, offset, end - offset,
+                          POSIX_FADV_WILLNEED);
+        }
+    }
+
+    int64_t _depth;
+
+    std::vector<source> _trees;
+    std::map<std::string, int> _fds;
+
+    std::deque<request> _queue;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop;
+
+    std::thread _reader;
+};
+
+#endif /* READAHEAD_H */
@@ -1,6 +1,12 @@
 #ifndef SPECIFICS_H
 #define SPECIFICS_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 template <typename T>
 bool within_hem_failure_region(T* t, int64_t i) {
     return ((*t->eleSCEta)[i] < -1.3
@@ -116,4 +122,106 @@ bool passes_electron_id(V* t, int64_t i, bool heavyion) {
         && std::abs((*t->eleEoverPInv)[i]) < ecuts[iptype][T][U][var::eop];
 }
 
+constexpr uint32_t id_bit(det d, wp w) {
+    return 1u << (d * wp::nwp + w);
+}
+
+constexpr uint32_t id_bit(wp w) {
+    return id_bit(det::barrel, w) | id_bit(det::endcap, w);
+}
+
+/* electrons are evaluated in blocks of a fixed number of lanes, so that
+ * the comparisons against each row of cuts vectorise */
+constexpr int64_t id_lanes = 8;
+
+/* evaluate all working points in both regions for every electron in one
+ * pass, writing one mask of id_bit(det, wp) flags per electron to masks,
+ * whose storage is reused from event to event. the basic selections and
+ * regions are masks rather than branches, applied to the flags of all
+ * working points of both regions */
+template <typename T>
+void electron_id_masks(T* t, ip iptype, std::vector<uint32_t>& masks) {
+    auto count = static_cast<int64_t>(t->eleSCEta->size());
+    masks.resize(count);
+
+    auto sceta = t->eleSCEta->data();
+    auto conv = t->eleConvVeto->data();
+    auto hits = t->eleMissHits->data();
+    auto ip3d = t->eleIP3D->data();
+    auto hoe = t->eleHoverEBc->data();
+    auto see = t->eleSigmaIEtaIEta_2012->data();
+    auto deta = t->eledEtaSeedAtVtx->data();
+    auto dphi = t->eledPhiAtVtx->data();
+    auto eop = t->eleEoverPInv->data();
+
+    constexpr uint32_t all = (1u << wp::nwp) - 1;
+
+    for (int64_t first = 0; first < count; first += id_lanes) {
+        auto size = std::min(id_lanes, count - first);
+
+        /* the block, padded with electrons that fail everything */
+        float h[id_lanes] = { };
+        float s[id_lanes] = { };
+        float de[id_lanes] = { };
+        float dp[id_lanes] = { };
+        float e[id_lanes] = { };
+        uint32_t region[id_lanes] = { };
+
+        for (int64_t k = 0; k < size; ++k) {
+            auto i = first + k;
+
+            uint32_t basic = (conv[i] != 0) & (hits[i] <= 1)
+                & (ip3d[i] < 0.03);
+
+            float abs_eta = std::abs(sceta[i]);
+            uint32_t in_barrel = (abs_eta > acuts[det::barrel][0])
+                & (abs_eta < acuts[det::barrel][1]);
+            uint32_t in_endcap = (abs_eta > acuts[det::endcap][0])
+                & (abs_eta < acuts[det::endcap][1]);
+
+            region[k] = basic * (in_barrel * (all << det::barrel * wp::nwp)
+                | in_endcap * (all << det::endcap * wp::nwp));
+
+            h[k] = hoe[i];
+            s[k] = see[i];
+            de[k] = std::abs(deta[i]);
+            dp[k] = std::abs(dphi[i]);
+            e[k] = std::abs(eop[i]);
+        }
+
+        uint32_t pass[id_lanes] = { };
+
+        for (int64_t d = 0; d < det::ndet; ++d) {
+            for (int64_t w = 0; w < wp::nwp; ++w) {
+                auto const& cuts = ecuts[iptype][d][w];
+                auto bit = id_bit(static_cast<det>(d), static_cast<wp>(w));
+
+                for (int64_t k = 0; k < id_lanes; ++k) {
+                    pass[k] |= bit * ((h[k] < cuts[var::hoe])
+                        & (s[k] < cuts[var::see])
+                        & (de[k] < cuts[var::deta])
+                        & (dp[k] < cuts[var::dphi])
+                        & (e[k] < cuts[var::eop]));
+                }
+            }
+        }
+
+        for (int64_t k = 0; k < size; ++k)
+            masks[first + k] = pass[k] & region[k];
+    }
+}
+
+/* branches read by electron_id_masks */
+inline std::vector<std::string> electron_id_columns() {
+    return { "hiBin", "eleSCEta", "eleConvVeto", "eleMissHits", "eleIP3D",
+             "eleHoverEBc", "eleSigmaIEtaIEta_2012", "eledEtaSeedAtVtx",
+             "eledPhiAtVtx", "eleEoverPInv" };
+}
+
+template <typename T>
+void electron_id_masks(T* t, bool heavyion, std::vector<uint32_t>& masks) {
+    auto iptype = heavyion ? (t->hiBin < 60 ? ip::cent : ip::peri) : ip::incl;
+    electron_id_masks(t, iptype, masks);
+}
+
 #endif /* SPECIFICS_H */
@@ -0,0 +1,519 @@
+#ifndef STAGES_H
+#define STAGES_H
+
+#include "etree.h"
+#include "instrument.h"
+#include "lookup.h"
+#include "matching.h"
+#include "specifics.h"
+#include "tnptree.h"
+
+#include "../git/config/include/configurer.h"
+
+#include "../git/foliage/include/eggen.h"
+#include "../git/foliage/include/electrons.h"
+#include "../git/foliage/include/event.h"
+#include "../git/foliage/include/hltobjs.h"
+#include "../git/foliage/include/l1objs.h"
+#include "../git/foliage/include/triggers.h"
+
+#include "../git/tricks-and-treats/include/maglev.h"
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TH2.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* stages of forest processing, each consuming the current event of trees
+ * harvested by a driver, so that several stages can share one read. each
+ * stage is given a timer of the event loop, which it laps as it goes */
+
+inline std::string shard_name(std::string output, int64_t index) {
+    auto ext = output.find(".root");
+    if (ext != std::string::npos)
+        output.erase(std::begin(output) + ext, std::end(output));
+
+    return output + ".shard" + std::to_string(index) + ".root";
+}
+
+inline int64_t count_entries(std::vector<std::string> const& files) {
+    TChain counter("ggHiNtuplizerGED/EventTree");
+    for (auto const& file : files)
+        counter.Add(file.data());
+
+    return counter.GetEntries();
+}
+
+inline std::string join(std::vector<std::string> const& values) {
+    std::string joined;
+    for (auto const& value : values) {
+        if (!joined.empty()) { joined += ","; }
+        joined += value;
+    }
+
+    return joined;
+}
+
+/* entries wanted of each file, in file order: all of them, or as many as
+ * remain of max_entries. files past max_entries are left out */
+inline std::vector<int64_t> entry_limits(std::vector<std::string> const& files,
+                                         int64_t max_entries) {
+    std::vector<int64_t> limits;
+
+    auto remaining = max_entries;
+    for (auto const& file : files) {
+        int64_t limit = 0;
+        if (max_entries) {
+            if (remaining <= 0) { break; }
+
+            limit = std::min(count_entries({ file }), remaining);
+            remaining -= limit;
+        }
+
+        limits.push_back(limit);
+    }
+
+    return limits;
+}
+
+/* every file within max_entries is processed into its own shard of each
+ * output, on up to nthreads workers, and the shards of each output are
+ * merged in file order, so outputs hold the same entries in the same
+ * baskets for any nthreads. outputs are pairs of tree and path, and
+ * process(file, limit, shards) writes one shard per output. shards are
+ * removed once merged, and kept if a merge fails */
+template <typename T>
+bool shard_and_merge(std::vector<std::string> const& files,
+                     int64_t max_entries, int64_t nthreads,
+                     std::vector<std::pair<std::string, std::string>> const&
+                         outputs,
+                     instrument& monitor, T process) {
+    auto limits = entry_limits(files, max_entries);
+
+    auto nshards = static_cast<int64_t>(limits.size());
+    nthreads = std::max(std::min(nthreads, nshards), int64_t(1));
+
+    if (nthreads > 1) { ROOT::EnableThreadSafety(); }
+
+    std::vector<std::vector<std::string>> shards(nshards);
+    for (int64_t i = 0; i < nshards; ++i)
+        for (auto const& output : outputs)
+            shards[i].push_back(shard_name(output.second, i));
+
+    std::atomic<int64_t> next(0);
+    auto work = [&]() {
+        for (int64_t i = next++; i < nshards; i = next++)
+            process(files[i], limits[i], shards[i]);
+    };
+
+    std::vector<std::thread> workers;
+    for (int64_t i = 0; i < nthreads; ++i)
+        workers.emplace_back(work);
+
+    for (auto& worker : workers)
+        worker.join();
+
+    auto timer = monitor.time(step::write);
+    for (std::size_t k = 0; k < outputs.size(); ++k) {
+        TChain* chain = new TChain(outputs[k].first.data());
+        for (auto const& shard : shards)
+            chain->Add(shard[k].data());
+
+        if (!chain->Merge(outputs[k].second.data(), "fast")) {
+            printf("merge failed: %s\n", outputs[k].second.data());
+            return false;
+        }
+
+        for (auto const& shard : shards)
+            std::remove(shard[k].data());
+    }
+
+    return true;
+}
+
+/* weights written before the lookup: a 2d histogram in elePt, eleEta */
+inline lookup from_histogram(TH2F* h) {
+    std::vector<std::vector<double>> edges;
+    for (auto axis : { h->GetXaxis(), h->GetYaxis() }) {
+        edges.emplace_back();
+        for (int64_t i = 1; i <= axis->GetNbins() + 1; ++i)
+            edges.back().push_back(axis->GetBinLowEdge(i));
+    }
+
+    lookup weights({ "elePt", "eleEta" }, edges);
+    for (int64_t i = 0; i < weights.size(); ++i) {
+        weights.values()[i] = h->GetBinContent(i);
+        weights.errors()[i] = h->GetBinError(i);
+    }
+
+    return weights;
+}
+
+/* settings of extract. read-only once loaded, so shared by all threads */
+struct extract_settings {
+    extract_settings(configurer* conf)
+            : paths(conf->get<std::vector<std::string>>("paths")),
+              skim(conf->get<std::vector<std::string>>("skim")),
+              weights(conf->get<std::string>("weights")),
+              heavyion(conf->get<bool>("heavyion")),
+              mc_branches(conf->get<bool>("mc_branches")),
+              hlt_branches(conf->get<bool>("hlt_branches")) {
+    }
+
+    std::string trigger_tree() const { return "hltanalysis/HltTree"; }
+
+    /* weight table and its columns, false for an unknown variable */
+    bool load() {
+        if (weights.empty()) { return true; }
+
+        TFile* fw = new TFile(weights.data(), "read");
+        if (!lw.read(fw, "weights")) {
+            auto hweights = (TH2F*)fw->Get("hweights");
+            if (!hweights) {
+                printf("no weights in %s\n", weights.data());
+                fw->Close();
+                return false;
+            }
+
+            lw = from_histogram(hweights);
+        }
+        fw->Close();
+
+        for (auto const& variable : lw.variables()) {
+            accessors.push_back(etree::column(variable));
+            if (!accessors.back()) {
+                printf("unknown weight variable: %s\n", variable.data());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /* settings the e tree depends on, the weights by path, size and time
+     * of last change, for records of resumable runs */
+    std::string fingerprint() const {
+        auto print = "paths=" + join(paths) + " skim=" + join(skim)
+            + " heavyion=" + std::to_string(heavyion) + " mc_branches="
+            + std::to_string(mc_branches) + " hlt_branches="
+            + std::to_string(hlt_branches) + " weights=" + weights;
+
+        if (!weights.empty()) {
+            FileStat_t stat;
+            gSystem->GetPathInfo(weights.data(), stat);
+
+            print += " " + std::to_string(stat.fSize) + " "
+                + std::to_string(stat.fMtime);
+        }
+
+        return print;
+    }
+
+    std::vector<std::string> paths;
+    std::vector<std::string> skim;
+    std::string weights;
+    bool heavyion;
+    bool mc_branches;
+    bool hlt_branches;
+
+    lookup lw;
+    std::vector<etree::accessor> accessors;
+};
+
+/* events with electrons passing the skim, written to the e tree */
+class extract_stage {
+  public:
+    extract_stage(extract_settings const& settings, eggen* tegg,
+                  electrons* tegm, triggers* thlt, event* tevt,
+                  std::string const& target)
+            : _s(settings),
+              _tegg(tegg),
+              _tegm(tegm),
+              _thlt(thlt),
+              _tevt(tevt) {
+        _f = new TFile(target.data(), "recreate");
+        _t = new TTree("e", "electrons");
+        _te = new etree(_t, _s.mc_branches, _s.hlt_branches);
+
+        for (auto accessor : _s.accessors) {
+            auto te = _te;
+            _columns.push_back([=](int64_t j) { return accessor(te, j); });
+        }
+    }
+
+    ~extract_stage() = default;
+
+    /* before the next event is read */
+    void clear() {
+        _te->clear();
+    }
+
+    void operator()(instrument::timer& timer, instrument& monitor) {
+        timer.lap(step::selection);
+
+        if (_tegm->nEle < 1) { return; }
+
+        if (!_s.skim.empty()) {
+            bool pass_skim = false;
+            for (auto const& path : _s.skim)
+                if (_thlt->accept(path) == 1)
+                    pass_skim = true;
+
+            if (!pass_skim) { return; }
+        }
+
+        monitor.count(tally::skimmed);
+        timer.lap(step::fill);
+
+        _te->copy(_tegg);
+        _te->copy(_tegm);
+        _te->copy(_thlt);
+        _te->copy(_tevt);
+
+        if (!_s.heavyion) {
+            _te->hiBin = 0;
+            _te->hiHF = 0;
+            _te->Ncoll = 1;
+        }
+
+        if (_s.mc_branches) {
+            constexpr float max_dr2 = 0.15 * 0.15;
+
+            if (!_s.weights.empty())
+                _s.lw.evaluate(_te->nEle, _columns, *_te->ele_weight);
+            else
+                _te->ele_weight->assign(_te->nEle, 1.f);
+
+            /* final state electrons, filtered once per event */
+            timer.lap(step::matching);
+            gen_objects gen(*_te->mcPt, *_te->mcEta, *_te->mcPhi,
+                final_state(*_te->mcPID, *_te->mcStatus, 11));
+
+            *_te->gen_index = gen.match(*_te->eleEta, *_te->elePhi,
+                                        max_dr2);
+
+            timer.lap(step::fill);
+        }
+
+        _t->Fill();
+        monitor.count(tally::filled);
+    }
+
+    void close() {
+        _f->Write("", TObject::kOverwrite);
+        _f->Close();
+    }
+
+  private:
+    extract_settings const& _s;
+
+    eggen* _tegg;
+    electrons* _tegm;
+    triggers* _thlt;
+    event* _tevt;
+
+    TFile* _f;
+    TTree* _t;
+    etree* _te;
+
+    std::vector<std::function<double(int64_t)>> _columns;
+};
+
+/* settings of flatten */
+struct tnp_settings {
+    tnp_settings(configurer* conf)
+            : paths(conf->get<std::vector<std::string>>("paths")),
+              tree(conf->get<std::string>("tree")),
+              tag_pt_min(conf->get<float>("tag_pt_min")),
+              l1pt(conf->get<float>("l1pt")),
+              l1dr(conf->get<float>("l1dr")),
+              hltpath(conf->get<std::string>("hltpath")),
+              hltsteps(conf->get<uint32_t>("hltsteps")),
+              hltpt(conf->get<float>("hltpt")),
+              hltdr(conf->get<float>("hltdr")) {
+    }
+
+    std::string trigger_tree() const { return tree + "/HltTree"; }
+    std::string object_tree() const { return "hltobject/" + hltpath; }
+
+    /* settings the tnp tree depends on, for records of resumable runs */
+    std::string fingerprint() const {
+        return "paths=" + join(paths) + " tree=" + tree
+            + " tag_pt_min=" + std::to_string(tag_pt_min) + " l1pt="
+            + std::to_string(l1pt) + " l1dr=" + std::to_string(l1dr)
+            + " hltpath=" + hltpath + " hltsteps="
+            + std::to_string(hltsteps) + " hltpt=" + std::to_string(hltpt)
+            + " hltdr=" + std::to_string(hltdr);
+    }
+
+    std::vector<std::string> paths;
+    std::string tree;
+    float tag_pt_min;
+    float l1pt;
+    float l1dr;
+    std::string hltpath;
+    uint32_t hltsteps;
+    float hltpt;
+    float hltdr;
+};
+
+/* tag and probe pairs of triggered events, written to the tnp tree */
+class tnp_stage {
+  public:
+    tnp_stage(tnp_settings const& settings, electrons* tree_egm,
+              triggers* tree_trg, l1objs* tree_l1, hltobjs* tree_hlt,
+              std::string const& target)
+            : _s(settings),
+              _l1dr2(settings.l1dr * settings.l1dr),
+              _hltdr2(settings.hltdr * settings.hltdr),
+              _tree_egm(tree_egm),
+              _tree_trg(tree_trg),
+              _tree_l1(tree_l1),
+              _tree_hlt(tree_hlt) {
+        _f = new TFile(target.data(), "recreate");
+        _t = new TTree("tnp", "electrons");
+        _tree_tnp = new tnptree(_t);
+    }
+
+    ~tnp_stage() = default;
+
+    /* before the next event is read */
+    void clear() {
+        _tree_trg->reset();
+    }
+
+    void operator()(instrument::timer& timer, instrument& monitor) {
+        timer.lap(step::selection);
+
+        if (_tree_trg->accept() != 1)
+            return;
+
+        if (_tree_egm->nEle < 2) { return; }
+
+        monitor.count(tally::skimmed);
+        timer.lap(step::matching);
+
+        /* select hlt objects passing final filter */
+        auto indices = final_filter(*_tree_hlt->pt, _s.hltsteps);
+
+        trigger_objects l1(_s.l1pt, *_tree_l1->egEt, *_tree_l1->egEta,
+            *_tree_l1->egPhi);
+        trigger_objects hlt(_s.hltpt, *_tree_hlt->pt, *_tree_hlt->eta,
+            *_tree_hlt->phi, indices);
+
+        auto l1mindr2 = l1.nearest(*_tree_egm->eleEta, *_tree_egm->elePhi);
+        auto hltmindr2 = hlt.nearest(*_tree_egm->eleEta, *_tree_egm->elePhi);
+
+        /* evaluate id */
+        timer.lap(step::id);
+        std::vector<int32_t> veto_id;
+        std::vector<int32_t> loose_id;
+        std::vector<int32_t> medium_id;
+        std::vector<int32_t> tight_id;
+
+        for (int64_t j = 0; j < _tree_egm->nEle; ++j) {
+            veto_id.push_back(passes_electron_id<
+                ip::incl, wp::veto, electrons>(_tree_egm, j));
+            loose_id.push_back(passes_electron_id<
+                ip::incl, wp::loose, electrons>(_tree_egm, j));
+            medium_id.push_back(passes_electron_id<
+                ip::incl, wp::medium, electrons>(_tree_egm, j));
+            tight_id.push_back(passes_electron_id<
+                ip::incl, wp::tight, electrons>(_tree_egm, j));
+        }
+
+        timer.lap(step::selection);
+
+        int64_t tag = -1;
+
+        for (int64_t j = 0; j < _tree_egm->nEle; ++j) {
+            if (l1mindr2[j] < _l1dr2 && hltmindr2[j] < _hltdr2
+                    && tight_id[j]
+                    && (*_tree_egm->elePt)[j] > _s.tag_pt_min) {
+                tag = j; break; }
+        }
+
+        if (tag < 0) { return; }
+
+        monitor.count(tally::tagged);
+        timer.lap(step::fill);
+
+        for (int64_t j = 0; j < _tree_egm->nEle; ++j) {
+            if (j == tag) { continue; }
+
+            if ((*_tree_egm->eleCharge)[tag] == (*_tree_egm->eleCharge)[j])
+                continue;
+
+            _tree_tnp->tag_pt = (*_tree_egm->elePt)[tag];
+            _tree_tnp->tag_eta = (*_tree_egm->eleEta)[tag];
+            _tree_tnp->tag_phi = (*_tree_egm->elePhi)[tag];
+            _tree_tnp->probe_pt = (*_tree_egm->elePt)[j];
+            _tree_tnp->probe_eta = (*_tree_egm->eleEta)[j];
+            _tree_tnp->probe_abseta = std::abs(_tree_tnp->probe_eta);
+            _tree_tnp->probe_phi = (*_tree_egm->elePhi)[j];
+            _tree_tnp->dr2_l1 = l1mindr2[j];
+            _tree_tnp->dr2_hlt = hltmindr2[j];
+            _tree_tnp->pass_l1 = l1mindr2[j] < _l1dr2;
+            _tree_tnp->pass_hlt = hltmindr2[j] < _hltdr2;
+            _tree_tnp->pass_veto_id = veto_id[j];
+            _tree_tnp->pass_loose_id = loose_id[j];
+            _tree_tnp->pass_medium_id = medium_id[j];
+            _tree_tnp->pass_tight_id = tight_id[j];
+
+            _tree_tnp->mass = std::sqrt(ml_invariant_mass<coords::collider>(
+                (*_tree_egm->elePt)[tag],
+                (*_tree_egm->eleEta)[tag],
+                (*_tree_egm->elePhi)[tag],
+                0.000511f,
+                (*_tree_egm->elePt)[j],
+                (*_tree_egm->eleEta)[j],
+                (*_tree_egm->elePhi)[j],
+                0.000511f));
+
+            _tree_tnp->weight = 1.f;
+
+            /* special variables for trigger versions */
+            _tree_tnp->pass_v1 = _tree_tnp->pass_hlt && _tree_trg->accept(
+                std::string("HLT_HIEle20_WPLoose_Gsf_v1")) == 1;
+            _tree_tnp->pass_v2 = _tree_tnp->pass_hlt && _tree_trg->accept(
+                std::string("HLT_HIEle20_WPLoose_Gsf_v2")) == 1;
+
+            _t->Fill();
+            monitor.count(tally::filled);
+        }
+    }
+
+    void close() {
+        _f->Write("", TObject::kOverwrite);
+        _f->Close();
+    }
+
+  private:
+    tnp_settings const& _s;
+    float _l1dr2;
+    float _hltdr2;
+
+    electrons* _tree_egm;
+    triggers* _tree_trg;
+    l1objs* _tree_l1;
+    hltobjs* _tree_hlt;
+
+    TFile* _f;
+    TTree* _t;
+    tnptree* _tree_tnp;
+};
+
+#endif /* STAGES_H */
@@ -0,0 +1,248 @@
+#include "../include/specifics.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+/* minimal stand-in for the electron columns read by the id */
+struct columns {
+    columns() {
+        for (auto v : { &elePt, &eleSCEta, &eleSCPhi, &eleIP3D, &eleHoverEBc,
+                        &eleSigmaIEtaIEta_2012, &eledEtaSeedAtVtx,
+                        &eledPhiAtVtx, &eleEoverPInv })
+            *v = new std::vector<float>();
+        for (auto v : { &eleConvVeto, &eleMissHits })
+            *v = new std::vector<int32_t>();
+    }
+
+    ~columns() {
+        for (auto v : { elePt, eleSCEta, eleSCPhi, eleIP3D, eleHoverEBc,
+                        eleSigmaIEtaIEta_2012, eledEtaSeedAtVtx,
+                        eledPhiAtVtx, eleEoverPInv })
+            delete v;
+        delete eleConvVeto;
+        delete eleMissHits;
+    }
+
+    int32_t hiBin;
+
+    std::vector<float>* elePt;
+    std::vector<float>* eleSCEta;
+    std::vector<float>* eleSCPhi;
+    std::vector<float>* eleIP3D;
+    std::vector<float>* eleHoverEBc;
+    std::vector<float>* eleSigmaIEtaIEta_2012;
+    std::vector<float>* eledEtaSeedAtVtx;
+    std::vector<float>* eledPhiAtVtx;
+    std::vector<float>* eleEoverPInv;
+    std::vector<int32_t>* eleConvVeto;
+    std::vector<int32_t>* eleMissHits;
+};
+
+/* pt falls steeply, so most electrons are below the 20 GeV of the pairs */
+void generate(std::mt19937& gen, columns* t, int64_t nele) {
+    std::exponential_distribution<float> pt(1. / 12.);
+    std::uniform_real_distribution<float> eta(-2.4, 2.4);
+    std::uniform_real_distribution<float> hoe(0., 0.3);
+    std::uniform_real_distribution<float> see(0., 0.05);
+    std::uniform_real_distribution<float> deta(-0.01, 0.01);
+    std::uniform_real_distribution<float> dphi(-0.2, 0.2);
+    std::uniform_real_distribution<float> eop(-0.1, 0.1);
+    std::uniform_real_distribution<float> ip3d(0., 0.04);
+    std::uniform_int_distribution<int32_t> hits(0, 2);
+    std::uniform_int_distribution<int32_t> veto(0, 4);
+    std::uniform_int_distribution<int32_t> cent(0, 199);
+
+    t->hiBin = cent(gen);
+
+    for (auto v : { t->elePt, t->eleSCEta, t->eleSCPhi, t->eleIP3D,
+                    t->eleHoverEBc, t->eleSigmaIEtaIEta_2012,
+                    t->eledEtaSeedAtVtx, t->eledPhiAtVtx, t->eleEoverPInv })
+        v->clear();
+    t->eleConvVeto->clear();
+    t->eleMissHits->clear();
+
+    for (int64_t i = 0; i < nele; ++i) {
+        t->elePt->push_back(pt(gen));
+        t->eleSCEta->push_back(eta(gen));
+        t->eleSCPhi->push_back(0.);
+        t->eleIP3D->push_back(ip3d(gen));
+        t->eleHoverEBc->push_back(hoe(gen));
+        t->eleSigmaIEtaIEta_2012->push_back(see(gen));
+        t->eledEtaSeedAtVtx->push_back(deta(gen));
+        t->eledPhiAtVtx->push_back(dphi(gen));
+        t->eleEoverPInv->push_back(eop(gen));
+        t->eleConvVeto->push_back(veto(gen) != 0);
+        t->eleMissHits->push_back(hits(gen));
+    }
+}
+
+/* scalar templates: every working point in both regions, one call each */
+template <wp W>
+uint32_t scalar_bits(columns* t, int64_t i) {
+    return passes_electron_id<det::barrel, W, columns>(t, i, true)
+            * id_bit(det::barrel, W)
+        | passes_electron_id<det::endcap, W, columns>(t, i, true)
+            * id_bit(det::endcap, W);
+}
+
+std::vector<uint32_t> scalar(columns* t) {
+    std::vector<uint32_t> masks;
+
+    auto count = static_cast<int64_t>(t->eleSCEta->size());
+    for (int64_t i = 0; i < count; ++i) {
+        masks.push_back(scalar_bits<wp::veto>(t, i)
+            | scalar_bits<wp::loose>(t, i)
+            | scalar_bits<wp::medium>(t, i)
+            | scalar_bits<wp::tight>(t, i));
+    }
+
+    return masks;
+}
+
+std::vector<uint32_t> batched(columns* t) {
+    std::vector<uint32_t> masks;
+    electron_id_masks(t, true, masks);
+
+    return masks;
+}
+
+/* loose id of both legs of every pair above 20 GeV, as in dielectrons */
+int64_t scalar_pairs(columns* t) {
+    int64_t sum = 0;
+
+    auto count = static_cast<int64_t>(t->eleSCEta->size());
+    for (int64_t j = 0; j < count; ++j) {
+        if ((*t->elePt)[j] < 20) { continue; }
+
+        int64_t is_1_barrel = passes_electron_id<
+            det::barrel, wp::loose, columns>(t, j, true);
+        int64_t is_1_endcap = passes_electron_id<
+            det::endcap, wp::loose, columns>(t, j, true);
+
+        if (!is_1_barrel && !is_1_endcap) { continue; }
+
+        for (int64_t k = j + 1; k < count; ++k) {
+            if ((*t->elePt)[k] < 20) { continue; }
+
+            int64_t is_2_barrel = passes_electron_id<
+                det::barrel, wp::loose, columns>(t, k, true);
+            int64_t is_2_endcap = passes_electron_id<
+                det::endcap, wp::loose, columns>(t, k, true);
+
+            if (!is_2_barrel && !is_2_endcap) { continue; }
+
+            sum += 1 + is_1_endcap + is_2_endcap;
+        }
+    }
+
+    return sum;
+}
+
+/* masks are kept from event to event, as a caller of the id would */
+int64_t batched_pairs(columns* t, std::vector<uint32_t>& ids) {
+    int64_t sum = 0;
+
+    electron_id_masks(t, true, ids);
+
+    auto count = static_cast<int64_t>(t->eleSCEta->size());
+    for (int64_t j = 0; j < count; ++j) {
+        if ((*t->elePt)[j] < 20) { continue; }
+
+        int64_t is_1_endcap = !!(ids[j] & id_bit(det::endcap, wp::loose));
+        if (!(ids[j] & id_bit(wp::loose))) { continue; }
+
+        for (int64_t k = j + 1; k < count; ++k) {
+            if ((*t->elePt)[k] < 20) { continue; }
+
+            int64_t is_2_endcap = !!(ids[k] & id_bit(det::endcap, wp::loose));
+            if (!(ids[k] & id_bit(wp::loose))) { continue; }
+
+            sum += 1 + is_1_endcap + is_2_endcap;
+        }
+    }
+
+    return sum;
+}
+
+template <typename T, typename U>
+double measure(std::vector<columns*> const& events, std::vector<T>& results,
+               U f) {
+    results.reserve(events.size());
+
+    int64_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto t : events) {
+        results.push_back(f(t));
+        count += t->eleSCEta->size();
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(stop - start).count()
+        / count;
+}
+
+template <typename T, typename U, typename V>
+int compare(std::string const& title, int64_t nevents, U scalar_,
+            V batched_) {
+    std::mt19937 gen(144);
+
+    printf("%s\n", title.data());
+    printf("%10s %16s %16s %10s\n",
+           "electrons", "scalar [ns/e]", "batched [ns/e]", "speedup");
+
+    for (int64_t nele = 1; nele <= 256; nele *= 2) {
+        /* cycle over a small pool so columns stay cache-resident, as they
+         * are after reading an entry */
+        std::vector<columns*> pool;
+        for (int64_t i = 0; i < 16; ++i) {
+            pool.push_back(new columns());
+            generate(gen, pool.back(), nele);
+        }
+
+        std::vector<columns*> events;
+        for (int64_t i = 0; i < nevents; ++i)
+            events.push_back(pool[i % 16]);
+
+        std::vector<T> expected;
+        std::vector<T> result;
+
+        auto t_ref = measure(events, expected, scalar_);
+        auto t_new = measure(events, result, batched_);
+
+        for (auto t : pool) { delete t; }
+
+        if (expected != result) {
+            printf("  mismatch at %li electrons\n", nele);
+            return 1;
+        }
+
+        printf("%10li %16.2f %16.2f %10.1f\n",
+               nele, t_ref, t_new, t_ref / t_new);
+    }
+
+    printf("\n");
+
+    return 0;
+}
+
+int bench_electron_id(int64_t nevents) {
+    /* claustro cuts never pass, so masks are directly comparable */
+    return compare<std::vector<uint32_t>>(
+            "all working points, both regions", nevents, scalar, batched)
+        || compare<int64_t>(
+            "loose id of dielectron pairs", nevents / 16, scalar_pairs,
+            [ids = std::vector<uint32_t>()](columns* t) mutable {
+                return batched_pairs(t, ids); });
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 2)
+        return bench_electron_id(std::atoll(argv[1]));
+
+    printf("usage: %s [events]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,312 @@
+#include "../include/matching.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/* reference implementation: final filter recomputed per electron */
+std::vector<int64_t> clean(std::vector<double> const& values, int64_t size) {
+    std::vector<double> handled;
+    std::vector<int64_t> indices;
+
+    for (int64_t i = 0; i < static_cast<int64_t>(values.size()); ++i) {
+        if (std::find(std::begin(handled), std::end(handled), values[i])
+            != std::end(handled)) { continue; }
+        if (std::count(std::begin(values), std::end(values), values[i])
+            == size) { handled.push_back(values[i]); indices.push_back(i); }
+    }
+
+    return indices;
+}
+
+float nearest_neighbour(float pt, float eta, float phi,
+                        std::vector<float> const& other_pt,
+                        std::vector<float> const& other_eta,
+                        std::vector<float> const& other_phi) {
+    float mindr2 = 999.f;
+
+    auto count = static_cast<int64_t>(other_eta.size());
+    for (int64_t i = 0; i < count; ++i) {
+        if (other_pt[i] < pt) { continue; }
+
+        float deta = eta - other_eta[i];
+        float dphi = oadphi(phi, other_phi[i]);
+        float dr2 = deta * deta + dphi * dphi;
+
+        if (dr2 < mindr2) { mindr2 = dr2; }
+    }
+
+    return mindr2;
+}
+
+struct event {
+    std::vector<float> ele_eta;
+    std::vector<float> ele_phi;
+    std::vector<double> hlt_pt;
+    std::vector<double> hlt_eta;
+    std::vector<double> hlt_phi;
+};
+
+/* each object appears once per filter step it passes. a few objects have
+ * nan pt or eta, as some hlt objects do */
+event generate(std::mt19937& gen, int64_t nobjects, int64_t nele,
+               int64_t steps) {
+    std::uniform_real_distribution<float> eta(-2.4, 2.4);
+    std::uniform_real_distribution<float> phi(-3.14159, 3.14159);
+    std::uniform_real_distribution<float> pt(5., 60.);
+    std::uniform_int_distribution<int64_t> passed(1, steps);
+    std::uniform_int_distribution<int64_t> invalid(0, 99);
+
+    event e;
+    for (int64_t i = 0; i < nele; ++i) {
+        e.ele_eta.push_back(eta(gen));
+        e.ele_phi.push_back(phi(gen));
+    }
+
+    for (int64_t i = 0; i < nobjects; ++i) {
+        double opt = pt(gen);
+        double oeta = eta(gen);
+        double ophi = phi(gen);
+
+        switch (invalid(gen)) {
+            case 0: opt = std::nan(""); break;
+            case 1: oeta = std::nan(""); break;
+        }
+
+        for (int64_t j = passed(gen); j > 0; --j) {
+            e.hlt_pt.push_back(opt);
+            e.hlt_eta.push_back(oeta);
+            e.hlt_phi.push_back(ophi);
+        }
+    }
+
+    return e;
+}
+
+struct gen_event {
+    std::vector<float> ele_eta;
+    std::vector<float> ele_phi;
+    std::vector<int32_t> mc_pid;
+    std::vector<int32_t> mc_status;
+    std::vector<float> mc_pt;
+    std::vector<float> mc_eta;
+    std::vector<float> mc_phi;
+};
+
+/* particles spread in eta and phi, every fourth close to an electron,
+ * with pt on a coarse grid so that ties occur. about 1% have nan eta and
+ * 0.1% nan pt */
+gen_event generate_gen(std::mt19937& gen, int64_t nparticles,
+                       int64_t nele) {
+    std::uniform_real_distribution<float> eta(-2.4, 2.4);
+    std::uniform_real_distribution<float> phi(-3.14159, 3.14159);
+    std::uniform_real_distribution<float> shift(-0.1, 0.1);
+    std::uniform_int_distribution<int32_t> pt(1, 8);
+    std::uniform_int_distribution<int32_t> pid(0, 3);
+    std::uniform_int_distribution<int32_t> status(1, 2);
+    std::uniform_int_distribution<int64_t> invalid(0, 999);
+
+    gen_event e;
+    for (int64_t i = 0; i < nele; ++i) {
+        e.ele_eta.push_back(eta(gen));
+        e.ele_phi.push_back(phi(gen));
+    }
+
+    for (int64_t i = 0; i < nparticles; ++i) {
+        int64_t near = (i / 4) % nele;
+        int32_t type = pid(gen);
+
+        e.mc_pid.push_back(type == 0 ? 22 : (type & 1 ? 11 : -11));
+        e.mc_status.push_back(status(gen));
+        e.mc_pt.push_back(5.f * pt(gen));
+
+        if (i % 4) {
+            e.mc_eta.push_back(eta(gen));
+            e.mc_phi.push_back(phi(gen));
+        } else {
+            e.mc_eta.push_back(e.ele_eta[near] + shift(gen));
+            e.mc_phi.push_back(e.ele_phi[near] + shift(gen));
+        }
+
+        auto draw = invalid(gen);
+        if (draw < 10) { e.mc_eta.back() = std::nan(""); }
+        if (draw == 10) { e.mc_pt.back() = std::nan(""); }
+    }
+
+    return e;
+}
+
+std::vector<float> reference(event const& e, float threshold, int64_t steps) {
+    std::vector<float> mindr2;
+
+    for (std::size_t j = 0; j < e.ele_eta.size(); ++j) {
+        auto indices = clean(e.hlt_pt, steps);
+
+        std::vector<float> ptfinal;
+        std::vector<float> etafinal;
+        std::vector<float> phifinal;
+
+        for (auto index : indices) {
+            ptfinal.push_back(e.hlt_pt[index]);
+            etafinal.push_back(e.hlt_eta[index]);
+            phifinal.push_back(e.hlt_phi[index]);
+        }
+
+        mindr2.push_back(nearest_neighbour(threshold, e.ele_eta[j],
+            e.ele_phi[j], ptfinal, etafinal, phifinal));
+    }
+
+    return mindr2;
+}
+
+std::vector<float> batched(event const& e, float threshold, int64_t steps) {
+    auto indices = final_filter(e.hlt_pt, steps);
+    trigger_objects hlt(threshold, e.hlt_pt, e.hlt_eta, e.hlt_phi, indices);
+
+    return hlt.nearest(e.ele_eta, e.ele_phi);
+}
+
+template <typename T>
+double measure(std::vector<event> const& events, std::vector<float>& sink,
+             T f, float threshold, int64_t steps) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& e : events) {
+        auto mindr2 = f(e, threshold, steps);
+        sink.insert(std::end(sink), std::begin(mindr2), std::end(mindr2));
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(stop - start).count()
+        / events.size();
+}
+
+int bench_matching(int64_t nevents, int64_t nele) {
+    constexpr float threshold = 20.f;
+    constexpr int64_t steps = 4;
+
+    std::mt19937 gen(144);
+
+    printf("%10s %16s %16s %10s\n",
+           "objects", "reference [us]", "batched [us]", "speedup");
+
+    for (int64_t nobjects = 4; nobjects <= 1024; nobjects *= 2) {
+        std::vector<event> events;
+        for (int64_t i = 0; i < nevents; ++i)
+            events.push_back(generate(gen, nobjects, nele, steps));
+
+        std::vector<float> expected;
+        std::vector<float> result;
+
+        auto t_ref = measure(events, expected, reference, threshold, steps);
+        auto t_new = measure(events, result, batched, threshold, steps);
+
+        if (expected != result) {
+            printf("  mismatch at %li objects\n", nobjects);
+            return 1;
+        }
+
+        printf("%10li %16.2f %16.2f %10.1f\n",
+               nobjects, t_ref, t_new, t_ref / t_new);
+    }
+
+    return 0;
+}
+
+/* reference implementation: gen match over every particle per electron */
+std::vector<int32_t> gen_reference(gen_event const& e, float max_dr2) {
+    std::vector<int32_t> indices;
+
+    for (std::size_t j = 0; j < e.ele_eta.size(); ++j) {
+        float maxpt = -1;
+        int32_t match = -1;
+
+        auto count = static_cast<int32_t>(e.mc_pt.size());
+        for (int32_t k = 0; k < count; ++k) {
+            if (std::abs(e.mc_pid[k]) != 11) { continue; }
+            if (e.mc_status[k] != 1) { continue; }
+            if (e.mc_pt[k] < maxpt) { continue; }
+
+            float deta = e.ele_eta[j] - e.mc_eta[k];
+            float dphi = oadphi(e.ele_phi[j], e.mc_phi[k]);
+            float dr2 = dphi * dphi + deta * deta;
+
+            if (dr2 < max_dr2) {
+                maxpt = e.mc_pt[k];
+                match = k;
+            }
+        }
+
+        indices.push_back(match);
+    }
+
+    return indices;
+}
+
+std::vector<int32_t> gen_sorted(gen_event const& e, float max_dr2) {
+    gen_objects gen(e.mc_pt, e.mc_eta, e.mc_phi,
+        final_state(e.mc_pid, e.mc_status, 11));
+
+    return gen.match(e.ele_eta, e.ele_phi, max_dr2);
+}
+
+template <typename T>
+double measure_gen(std::vector<gen_event> const& events,
+                   std::vector<int32_t>& sink, T f, float max_dr2) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& e : events) {
+        auto indices = f(e, max_dr2);
+        sink.insert(std::end(sink), std::begin(indices), std::end(indices));
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(stop - start).count()
+        / events.size();
+}
+
+int bench_gen_matching(int64_t nevents, int64_t nele) {
+    constexpr float max_dr2 = 0.01f;
+
+    std::mt19937 gen(144);
+
+    printf("%10s %16s %16s %10s\n",
+           "particles", "reference [us]", "sorted [us]", "speedup");
+
+    for (int64_t nparticles = 4; nparticles <= 1024; nparticles *= 2) {
+        std::vector<gen_event> events;
+        for (int64_t i = 0; i < nevents; ++i)
+            events.push_back(generate_gen(gen, nparticles, nele));
+
+        std::vector<int32_t> expected;
+        std::vector<int32_t> result;
+
+        auto t_ref = measure_gen(events, expected, gen_reference, max_dr2);
+        auto t_new = measure_gen(events, result, gen_sorted, max_dr2);
+
+        if (expected != result) {
+            printf("  mismatch at %li particles\n", nparticles);
+            return 1;
+        }
+
+        printf("%10li %16.2f %16.2f %10.1f\n",
+               nparticles, t_ref, t_new, t_ref / t_new);
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 3) {
+        auto nevents = std::atoll(argv[1]);
+        auto nele = std::atoll(argv[2]);
+
+        return bench_matching(nevents, nele)
+            || bench_gen_matching(nevents, nele);
+    }
+
+    printf("usage: %s [events] [electrons]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,76 @@
+#include "../include/quantiles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/* largest normalised rank error of the sketch over a grid of quantiles,
+ * with ranks taken from the sorted values. ties count in favour of the
+ * estimate */
+template <typename T>
+double rank_error(T distribution, int64_t nvalues, int64_t k) {
+    std::mt19937 gen(144);
+
+    quantiles sketch(k, 0);
+    std::vector<double> values;
+    for (int64_t i = 0; i < nvalues; ++i) {
+        double value = distribution(gen);
+        sketch.fill(value);
+        values.push_back(value);
+    }
+
+    std::sort(std::begin(values), std::end(values));
+
+    double error = 0.;
+    for (int64_t i = 1; i < 200; ++i) {
+        double q = i / 200.;
+        double estimate = sketch.quantile(q);
+
+        auto low = std::lower_bound(std::begin(values), std::end(values),
+                                    estimate) - std::begin(values);
+        auto high = std::upper_bound(std::begin(values), std::end(values),
+                                     estimate) - std::begin(values);
+
+        double rank = q * nvalues;
+        double distance = 0.;
+        if (rank < low) { distance = low - rank; }
+        if (rank > high) { distance = rank - high; }
+
+        error = std::max(error, distance / nvalues);
+    }
+
+    return error;
+}
+
+int check_quantiles(int64_t nvalues, int64_t k, double bound) {
+    double errors[3] = {
+        rank_error(std::uniform_real_distribution<double>(0., 1.),
+                   nvalues, k),
+        rank_error(std::normal_distribution<double>(0., 1.), nvalues, k),
+        rank_error(std::exponential_distribution<double>(1.), nvalues, k),
+    };
+
+    char const* names[3] = { "uniform", "normal", "exponential" };
+
+    int status = 0;
+    for (int64_t i = 0; i < 3; ++i) {
+        printf("%12s: rank error %.2e (bound %.2e)\n",
+               names[i], errors[i], bound);
+
+        if (errors[i] > bound) { status = 1; }
+    }
+
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4)
+        return check_quantiles(std::atoll(argv[1]), std::atoll(argv[2]),
+                               std::atof(argv[3]));
+
+    printf("usage: %s [values] [k] [bound]\n", argv[0]);
+    return 1;
+}
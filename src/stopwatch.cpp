@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* events read by a tool, from "read" in the events of its json report,
+ * or -1 if there is none */
+int64_t events_in(char const* report) {
+    std::ifstream f(report);
+    std::string json((std::istreambuf_iterator<char>(f)),
+                     std::istreambuf_iterator<char>());
+
+    auto events = json.find("\"events\"");
+    if (events == std::string::npos) { return -1; }
+
+    auto read = json.find("\"read\":", events);
+    if (read == std::string::npos) { return -1; }
+
+    return std::atoll(json.data() + read + 7);
+}
+
+/* total size of a comma separated list of files, missing ones as empty */
+double size_of(char const* outputs) {
+    std::istringstream list(outputs);
+
+    double size = 0.;
+    std::string output;
+    while (std::getline(list, output, ',')) {
+        struct stat info;
+        if (!stat(output.data(), &info)) { size += info.st_size; }
+    }
+
+    return size;
+}
+
+/* run a command with its output sent to a log, then report throughput in
+ * events read as counted in the report of the command, peak resident
+ * memory and the size of its outputs */
+int stopwatch(char const* label, char const* report, char const* outputs,
+              char const* log, char* command[]) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto pid = fork();
+    if (pid == 0) {
+        auto fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+
+        execv(command[0], command);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+        printf("%-24s failed to run %s\n", label, command[0]);
+        return 1;
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(stop - start).count();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("%-24s failed, see %s\n", label, log);
+        return 1;
+    }
+
+    auto events = events_in(report);
+    if (events < 0) {
+        printf("%-24s no events in %s\n", label, report);
+        return 1;
+    }
+
+    auto size = size_of(outputs);
+
+    /* ru_maxrss is in kB on linux */
+    printf("%-24s %10.0f events/s %10.1f MB rss %10.1f MB output\n",
+           label, events / seconds, usage.ru_maxrss / 1024.,
+           size / 1048576.);
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 5)
+        return stopwatch(argv[1], argv[2], argv[3], argv[4], argv + 5);
+
+    printf("usage: %s [label] [report] [outputs] [log] [command...]\n",
+           argv[0]);
+    return 1;
+}